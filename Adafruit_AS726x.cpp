@@ -25,6 +25,7 @@
  */
 
 #include "Adafruit_AS726x.h"
+#include <stddef.h>
 
 Adafruit_AS726x::~Adafruit_AS726x(void) {
   if (i2c_dev)
@@ -41,8 +42,15 @@ Adafruit_AS726x::~Adafruit_AS726x(void) {
 bool Adafruit_AS726x::begin(TwoWire *theWire) {
   if (i2c_dev)
     delete i2c_dev;
+  _hw_version = 0;
   i2c_dev = new Adafruit_I2CDevice(_i2caddr, theWire);
-  if (!i2c_dev->begin()) {
+  // the probe is a bus transaction like any other
+  if (_bus_lock)
+    _bus_lock(_bus_lock_ctx);
+  bool found = i2c_dev->begin();
+  if (_bus_lock)
+    _bus_unlock(_bus_lock_ctx);
+  if (!found) {
     return false;
   }
 
@@ -59,6 +67,13 @@ bool Adafruit_AS726x::begin(TwoWire *theWire) {
   // TODO: add support for other devices
   if (version != 0x40)
     return false;
+  _hw_version = version;
+
+  _fw_version = ((uint16_t)virtualRead(AS726X_FW_VERSION) << 8) |
+                virtualRead(AS726X_FW_VERSION + 1);
+
+  // stored corrections are optional, carry on uncorrected if there are none
+  loadCorrections();
 
   enableInterrupt();
 
@@ -74,6 +89,33 @@ bool Adafruit_AS726x::begin(TwoWire *theWire) {
   return true;
 }
 
+/**************************************************************************/
+/*!
+    @brief  set functions that guard the I2C bus when it is shared between
+   tasks or threads. The lock is held for each complete virtual register
+   read or write, so other devices on the bus can be used between them.
+   For example pass functions that take and give a FreeRTOS mutex, or that
+   lock and unlock a std::mutex passed as ctx. Call before begin() so the
+   probe, reset and version check are guarded too.
+    @param lockFunc function that takes the lock, or NULL for no locking
+    @param unlockFunc function that releases the lock. Required whenever
+   lockFunc is set, locking is turned off if either is NULL.
+    @param ctx Optional pointer passed to both functions, such as the mutex
+*/
+/**************************************************************************/
+void Adafruit_AS726x::setBusLock(as726x_lock_t lockFunc,
+                                 as726x_lock_t unlockFunc, void *ctx) {
+  if (!lockFunc || !unlockFunc) {
+    lockFunc = NULL;
+    unlockFunc = NULL;
+    ctx = NULL;
+  }
+
+  _bus_lock = lockFunc;
+  _bus_unlock = unlockFunc;
+  _bus_lock_ctx = ctx;
+}
+
 /**************************************************************************/
 /*!
     @brief  turn on the driver LED
@@ -278,6 +320,59 @@ void Adafruit_AS726x::readCalibratedValues(float *buf, uint8_t num) {
   }
 }
 
+// channel gain of each channel_gain setting, in tenths
+static const uint16_t as726x_gain_x10[] = {10, 37, 160, 640};
+
+/**************************************************************************/
+/*!
+    @brief  take a high dynamic range reading by fusing one-shot conversions
+   at several gain settings. Conversions run from the highest selected gain
+   down, and stop as soon as no channel is saturated, so a dim scene costs a
+   single conversion. Each conversion sets the gain, clears DATA_RDY and
+   starts ONE_SHOT mode with one CONTROL_SETUP write, and only channels that
+   were still saturated are read back. Like startMeasurement(), this leaves
+   the sensor in ONE_SHOT mode, and it is left at the last gain used.
+    @param buf the buffer to read the data into. Must hold
+   AS726x_NUM_CHANNELS values, scaled to GAIN_64X counts.
+    @param gains Optional mask of gains to use, bit n selecting channel_gain
+   n. Defaults to AS726x_HDR_ALL_GAINS
+    @return true if every channel was unsaturated at one of the gains, false
+   if some channel was still saturated at the lowest gain. Also false,
+   without touching the sensor or buf, if gains selects no gain.
+*/
+/**************************************************************************/
+bool Adafruit_AS726x::readHDRValues(uint32_t *buf, uint8_t gains) {
+  uint8_t pending = (1 << AS726x_NUM_CHANNELS) - 1;
+
+  if (!(gains & AS726x_HDR_ALL_GAINS))
+    return false;
+
+  for (int8_t gain = GAIN_64X; gain >= GAIN_1X && pending; gain--) {
+    if (!(gains & (1 << gain)))
+      continue;
+
+    _control_setup.GAIN = gain;
+    _control_setup.DATA_RDY = 0;
+    _control_setup.BANK = ONE_SHOT;
+    virtualWrite(AS726X_CONTROL_SETUP, _control_setup.get());
+
+    while (!dataReady())
+      delay(1);
+
+    uint16_t div = as726x_gain_x10[gain];
+    for (uint8_t i = 0; i < AS726x_NUM_CHANNELS; i++) {
+      if (!(pending & (1 << i)))
+        continue;
+      uint16_t raw = readChannel(AS7262_VIOLET + (i << 1));
+      buf[i] = ((uint32_t)raw * as726x_gain_x10[GAIN_64X] + (div >> 1)) / div;
+      if (raw < AS726x_SATURATION)
+        pending &= ~(1 << i);
+    }
+  }
+
+  return pending == 0;
+}
+
 /**************************************************************************/
 /*!
     @brief  read an individual calibrated spectral channel
@@ -297,6 +392,159 @@ float Adafruit_AS726x::readCalibratedValue(uint8_t channel) {
   return ret;
 }
 
+/**************************************************************************/
+/*!
+    @brief  read the raw channels and apply the active corrections to them at
+   the current device temperature
+    @param buf the buffer to read the data into. Must hold AS726x_NUM_CHANNELS
+   values.
+    @return true if the values were corrected, false if they are raw because
+   no corrections apply at the current gain and integration time.
+*/
+/**************************************************************************/
+bool Adafruit_AS726x::readCorrectedValues(uint16_t *buf) {
+  readRawValues(buf);
+  if (!_corrections_valid)
+    return false;
+  return applyCorrections(buf, readTemperature());
+}
+
+static uint16_t as726x_crc16(const uint8_t *buf, uint16_t len) {
+  uint16_t crc = 0xFFFF;
+
+  while (len--) {
+    crc ^= (uint16_t)*buf++ << 8;
+    for (uint8_t i = 0; i < 8; i++)
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+/**************************************************************************/
+/*!
+    @brief  set the non-volatile storage used by loadCorrections() and
+   saveCorrections(), such as EEPROM or a flash page. Call before begin() to
+   have the corrections loaded there.
+    @param readFunc function that reads from the storage
+    @param writeFunc function that writes to the storage, or NULL if it is
+   read only
+    @param addr Optional address of the corrections in the storage. Defaults
+   to 0
+*/
+/**************************************************************************/
+void Adafruit_AS726x::setCorrectionStore(as726x_store_read_t readFunc,
+                                         as726x_store_write_t writeFunc,
+                                         uint16_t addr) {
+  _store_read = readFunc;
+  _store_write = writeFunc;
+  _store_addr = addr;
+}
+
+/**************************************************************************/
+/*!
+    @brief  load corrections from the correction store in a single read. They
+   are only used if the checksum matches and they were made with this device
+   and firmware version.
+    @return true if corrections were loaded, false otherwise.
+*/
+/**************************************************************************/
+bool Adafruit_AS726x::loadCorrections() {
+  as726x_corrections_t corr;
+
+  // never keep corrections that belong to another sensor
+  _corrections_valid = false;
+
+  if (!_store_read ||
+      !_store_read(_store_addr, (uint8_t *)&corr, sizeof(corr)))
+    return false;
+
+  if (corr.crc != as726x_crc16((const uint8_t *)&corr,
+                               offsetof(as726x_corrections_t, crc)) ||
+      corr.hw_version != _hw_version || corr.fw_version != _fw_version)
+    return false;
+
+  _corrections = corr;
+  _corrections_valid = true;
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  make corrections active and write them to the correction store.
+   Needs a successful begin() first, to read the versions the corrections
+   are keyed by.
+    @param corr the corrections to save. The version and crc fields are
+   filled in.
+    @return true on success, false if corr is NULL, begin() has not
+   succeeded, there is no writable store or the write failed. The
+   corrections are active unless one of the first two applies.
+*/
+/**************************************************************************/
+bool Adafruit_AS726x::saveCorrections(const as726x_corrections_t *corr) {
+  if (!corr || !setCorrections(corr))
+    return false;
+
+  if (!_store_write)
+    return false;
+
+  return _store_write(_store_addr, (const uint8_t *)&_corrections,
+                      sizeof(_corrections));
+}
+
+/**************************************************************************/
+/*!
+    @brief  make corrections active without saving them. Needs a successful
+   begin() first, to read the versions the corrections are keyed by.
+    @param corr the corrections to use, or NULL to stop correcting. The
+   version and crc fields are filled in.
+    @return true if the corrections are now active, false if corr is NULL or
+   begin() has not succeeded.
+*/
+/**************************************************************************/
+bool Adafruit_AS726x::setCorrections(const as726x_corrections_t *corr) {
+  _corrections_valid = false;
+  // the versions are only known once begin() has found the sensor
+  if (!corr || !_hw_version)
+    return false;
+
+  _corrections = *corr;
+  _corrections.hw_version = _hw_version;
+  _corrections.fw_version = _fw_version;
+  _corrections.crc = as726x_crc16((const uint8_t *)&_corrections,
+                                  offsetof(as726x_corrections_t, crc));
+  _corrections_valid = true;
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  subtract the temperature compensated dark offsets from a raw
+   frame and scale it by the channel gains, in place. Does nothing if no
+   corrections are active, or if they were measured at a different gain or
+   integration time than the sensor is set to.
+    @param buf AS726x_NUM_CHANNELS raw values, as from readRawValues()
+    @param temp the device temperature the frame was taken at, in C
+    @return true if the frame was corrected, false otherwise.
+*/
+/**************************************************************************/
+bool Adafruit_AS726x::applyCorrections(uint16_t *buf, uint8_t temp) {
+  if (!_corrections_valid ||
+      _corrections.sensor_gain != _control_setup.GAIN ||
+      _corrections.int_time != _int_time.INT_T)
+    return false;
+
+  int16_t dt = (int16_t)temp - _corrections.ref_temp;
+  for (uint8_t i = 0; i < AS726x_NUM_CHANNELS; i++) {
+    int32_t v = (int32_t)buf[i] - _corrections.dark[i] -
+                (((int32_t)_corrections.tempco[i] * dt) >> 8);
+    if (v < 0)
+      v = 0;
+    uint32_t scaled = ((uint32_t)v * _corrections.gain[i]) >> 12;
+    buf[i] = scaled > 0xFFFF ? 0xFFFF : scaled;
+  }
+  return true;
+}
+
 void Adafruit_AS726x::write8(byte reg, byte value) {
   this->write(reg, &value, 1);
 }
@@ -310,6 +558,9 @@ uint8_t Adafruit_AS726x::read8(byte reg) {
 
 uint8_t Adafruit_AS726x::virtualRead(uint8_t addr) {
   volatile uint8_t status, d;
+  // hold the bus from the first status poll until the data is read back
+  if (_bus_lock)
+    _bus_lock(_bus_lock_ctx);
   while (1) {
     // Read slave I²C status to see if the read buffer is ready.
     status = read8(AS726X_SLAVE_STATUS_REG);
@@ -329,11 +580,16 @@ uint8_t Adafruit_AS726x::virtualRead(uint8_t addr) {
   }
   // Read the data to complete the operation.
   d = read8(AS726X_SLAVE_READ_REG);
+  if (_bus_lock)
+    _bus_unlock(_bus_lock_ctx);
   return d;
 }
 
 void Adafruit_AS726x::virtualWrite(uint8_t addr, uint8_t value) {
   volatile uint8_t status;
+  // hold the bus from the first status poll until the data is written
+  if (_bus_lock)
+    _bus_lock(_bus_lock_ctx);
   while (1) {
     // Read slave I²C status to see if the write buffer is ready.
     status = read8(AS726X_SLAVE_STATUS_REG);
@@ -355,6 +611,8 @@ void Adafruit_AS726x::virtualWrite(uint8_t addr, uint8_t value) {
   // Send the data to complete the operation.
   write8(AS726X_SLAVE_WRITE_REG, value);
   // Serial.print(" = 0x"); Serial.println(value, HEX);
+  if (_bus_lock)
+    _bus_unlock(_bus_lock_ctx);
 }
 
 void Adafruit_AS726x::read(uint8_t reg, uint8_t *buf, uint8_t num) {
@@ -151,6 +151,8 @@ enum drv_led_current_limits {
 
 #define AS726x_INTEGRATION_TIME_MULT 2.8 ///< multiplier for integration time
 #define AS726x_NUM_CHANNELS 6            ///< number of sensor channels
+#define AS726x_SATURATION 0xFFFF         ///< raw count of a saturated channel
+#define AS726x_HDR_ALL_GAINS 0x0F        ///< HDR gain mask using every gain
 
 /**************************************************************************/
 /*!
@@ -166,6 +168,44 @@ enum {
   AS726x_RED,
 };
 
+/**************************************************************************/
+/*!
+    @brief  Per-sensor corrections applied by applyCorrections(). They are
+   keyed by the versions read at begin(). begin() only accepts hardware
+   version 0x40, so in practice the key is the firmware version. Offsets and
+   gains only hold for the channel gain and integration time they were
+   measured at, which the caller fills in.
+*/
+/**************************************************************************/
+typedef struct {
+  uint16_t fw_version; ///< AS726X_FW_VERSION of the sensor
+  uint8_t hw_version;  ///< AS726X_HW_VERSION of the sensor
+  uint8_t ref_temp;    ///< temperature the dark offsets were measured at, in C
+  uint8_t sensor_gain; ///< channel_gain the corrections were measured at
+  uint8_t int_time;    ///< integration time they were measured at
+  uint16_t dark[AS726x_NUM_CHANNELS]; ///< dark offsets in raw counts
+  uint16_t gain[AS726x_NUM_CHANNELS]; ///< gain corrections, 4096 is 1.0
+  int16_t tempco[AS726x_NUM_CHANNELS]; ///< dark offset drift in 1/256 counts
+                                       ///< per degree C
+  uint16_t crc; ///< CRC-16 of the fields above
+} as726x_corrections_t;
+
+/*!
+    @brief  Reads len bytes of non-volatile storage at addr into buf
+*/
+typedef bool (*as726x_store_read_t)(uint16_t addr, uint8_t *buf, uint16_t len);
+
+/*!
+    @brief  Writes len bytes from buf into non-volatile storage at addr
+*/
+typedef bool (*as726x_store_write_t)(uint16_t addr, const uint8_t *buf,
+                                     uint16_t len);
+
+/*!
+    @brief  Takes or releases a lock guarding the shared I2C bus
+*/
+typedef void (*as726x_lock_t)(void *ctx);
+
 /**************************************************************************/
 /*!
     @brief  Class that stores state and functions for interacting with AS726x
@@ -184,6 +224,9 @@ public:
 
   bool begin(TwoWire *theWire = &Wire);
 
+  void setBusLock(as726x_lock_t lockFunc, as726x_lock_t unlockFunc,
+                  void *ctx = NULL);
+
   /*========= LED STUFF =========*/
 
   // Set indicator LED current
@@ -305,11 +348,37 @@ public:
 
   void readCalibratedValues(float *buf, uint8_t num = AS726x_NUM_CHANNELS);
 
+  bool readCorrectedValues(uint16_t *buf);
+
+  bool readHDRValues(uint32_t *buf, uint8_t gains = AS726x_HDR_ALL_GAINS);
+
   /*==== END MEASUREMENTS =====*/
 
+  /*======== CORRECTIONS ========*/
+
+  void setCorrectionStore(as726x_store_read_t readFunc,
+                          as726x_store_write_t writeFunc, uint16_t addr = 0);
+  bool loadCorrections();
+  bool saveCorrections(const as726x_corrections_t *corr);
+  bool setCorrections(const as726x_corrections_t *corr);
+  bool applyCorrections(uint16_t *buf, uint8_t temp);
+
+  /*==== END CORRECTIONS =====*/
+
 private:
   Adafruit_I2CDevice *i2c_dev = NULL; ///< Pointer to I2C bus interface
   uint8_t _i2caddr;                   ///< the I2C address of the sensor
+  as726x_lock_t _bus_lock = NULL;     ///< takes the shared bus lock
+  as726x_lock_t _bus_unlock = NULL;   ///< releases the shared bus lock
+  void *_bus_lock_ctx = NULL;         ///< passed to the lock functions
+  uint8_t _hw_version = 0;            ///< AS726X_HW_VERSION read at begin()
+  uint16_t _fw_version = 0;           ///< AS726X_FW_VERSION read at begin()
+
+  as726x_store_read_t _store_read = NULL;   ///< correction store reader
+  as726x_store_write_t _store_write = NULL; ///< correction store writer
+  uint16_t _store_addr = 0;                 ///< correction store address
+  as726x_corrections_t _corrections = {};   ///< active corrections
+  bool _corrections_valid = false;          ///< true if corrections are set
 
   void write8(byte reg, byte value);
   uint8_t read8(byte reg);
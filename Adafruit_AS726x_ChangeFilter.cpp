@@ -0,0 +1,208 @@
+/*!
+ * @file Adafruit_AS726x_ChangeFilter.cpp
+ *
+ * Suppresses AS726x frames that match the last emitted frame within a
+ * per-channel threshold. A channel that has just changed stays active and
+ * uses its threshold minus the hysteresis until a frame holds it steady, so
+ * a slow drift is followed closely once detected while noise at rest needs
+ * the full threshold to get through.
+ *
+ * Delta frames are a header byte holding the mask of channels present (with
+ * AS726x_DELTA_KEYFRAME set on the first frame) followed by one zigzag
+ * varint per present channel.
+ *
+ * Adafruit invests time and resources providing this open source code,
+ * please support Adafruit and open-source hardware by purchasing
+ * products from Adafruit!
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#include "Adafruit_AS726x_ChangeFilter.h"
+
+/**************************************************************************/
+/*!
+    @brief  Class constructor. Every channel starts with a zero threshold, so
+   any change is emitted until thresholds are set.
+*/
+/**************************************************************************/
+Adafruit_AS726x_ChangeFilter::Adafruit_AS726x_ChangeFilter() {
+  _relative = 0;
+  setThresholds(0);
+}
+
+/**************************************************************************/
+/*!
+    @brief  set the change threshold for one channel
+    @param channel the channel to set, one of AS726x_VIOLET ... AS726x_RED
+    @param threshold the change needed to emit a frame. Counts, or 1/1024ths
+   of the last emitted value if relative is true.
+    @param hysteresis Optional amount the threshold drops by while the channel
+   is changing, in the same units. Defaults to 0
+    @param relative Optional true for a relative threshold. Defaults to false
+*/
+/**************************************************************************/
+void Adafruit_AS726x_ChangeFilter::setThreshold(uint8_t channel,
+                                                uint16_t threshold,
+                                                uint16_t hysteresis,
+                                                bool relative) {
+  if (channel >= AS726x_NUM_CHANNELS)
+    return;
+
+  _threshold[channel] = threshold;
+  _hysteresis[channel] = hysteresis;
+  if (relative)
+    _relative |= (1 << channel);
+  else
+    _relative &= ~(1 << channel);
+}
+
+/**************************************************************************/
+/*!
+    @brief  set the same change threshold for every channel and forget the
+   last emitted frame
+    @param threshold the change needed to emit a frame. Counts, or 1/1024ths
+   of the last emitted value if relative is true.
+    @param hysteresis Optional amount the threshold drops by while a channel
+   is changing, in the same units. Defaults to 0
+    @param relative Optional true for relative thresholds. Defaults to false
+*/
+/**************************************************************************/
+void Adafruit_AS726x_ChangeFilter::setThresholds(uint16_t threshold,
+                                                 uint16_t hysteresis,
+                                                 bool relative) {
+  for (uint8_t i = 0; i < AS726x_NUM_CHANNELS; i++)
+    setThreshold(i, threshold, hysteresis, relative);
+  reset();
+}
+
+/**************************************************************************/
+/*!
+    @brief  forget the last emitted frame so the next one is always emitted
+*/
+/**************************************************************************/
+void Adafruit_AS726x_ChangeFilter::reset() {
+  memset(_last, 0, sizeof(_last));
+  _active = 0;
+  _primed = false;
+}
+
+/**************************************************************************/
+/*!
+    @brief  check a frame against the last emitted one, and make it the last
+   emitted frame if it changed enough
+    @param frame AS726x_NUM_CHANNELS values, as from readRawValues()
+    @return true if the frame should be emitted, false otherwise.
+*/
+/**************************************************************************/
+bool Adafruit_AS726x_ChangeFilter::update(const uint16_t *frame) {
+  uint8_t changed = 0;
+
+  for (uint8_t i = 0; i < AS726x_NUM_CHANNELS; i++) {
+    uint16_t delta =
+        frame[i] > _last[i] ? frame[i] - _last[i] : _last[i] - frame[i];
+    uint32_t limit = _threshold[i];
+
+    // a relative threshold over 1024 allows more than 100% change
+    if (_relative & (1 << i))
+      limit = (_last[i] * limit) >> 10;
+    if (_active & (1 << i))
+      limit = limit > _hysteresis[i] ? limit - _hysteresis[i] : 0;
+
+    if (delta > limit)
+      changed |= (1 << i);
+  }
+
+  if (_primed && !changed) {
+    _active = 0;
+    return false;
+  }
+
+  memcpy(_last, frame, sizeof(_last));
+  // the first frame is a baseline, not a change
+  _active = _primed ? changed : 0;
+  _primed = true;
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  run a frame through update() and, if it is emitted, encode it as
+   a delta against the previous emitted frame
+    @param frame AS726x_NUM_CHANNELS values, as from readRawValues()
+    @param out buffer of at least AS726x_DELTA_MAX_LEN bytes for the encoding
+    @return the number of bytes written, or 0 if the frame was suppressed.
+*/
+/**************************************************************************/
+uint8_t Adafruit_AS726x_ChangeFilter::encodeDelta(const uint16_t *frame,
+                                                  uint8_t *out) {
+  uint16_t prev[AS726x_NUM_CHANNELS];
+  bool keyframe = !_primed;
+
+  memcpy(prev, _last, sizeof(prev));
+  if (!update(frame))
+    return 0;
+
+  uint8_t len = 1;
+  out[0] = keyframe ? AS726x_DELTA_KEYFRAME : 0;
+  for (uint8_t i = 0; i < AS726x_NUM_CHANNELS; i++) {
+    int32_t delta = (int32_t)frame[i] - (keyframe ? 0 : prev[i]);
+    if (delta == 0)
+      continue;
+
+    out[0] |= (1 << i);
+    uint32_t zz = delta < 0 ? ((uint32_t)(-delta) << 1) - 1 : delta << 1;
+    while (zz >= 0x80) {
+      out[len++] = (zz & 0x7F) | 0x80;
+      zz >>= 7;
+    }
+    out[len++] = zz;
+  }
+  return len;
+}
+
+/**************************************************************************/
+/*!
+    @brief  apply an encoded delta to the previously decoded frame
+    @param in the encoded bytes, as from encodeDelta()
+    @param len the number of encoded bytes
+    @param frame AS726x_NUM_CHANNELS values holding the previous decoded frame,
+   updated in place. Ignored before a keyframe.
+    @return the number of bytes consumed, or 0 if the encoding is malformed.
+*/
+/**************************************************************************/
+uint8_t Adafruit_AS726x_ChangeFilter::decodeDelta(const uint8_t *in,
+                                                  uint8_t len,
+                                                  uint16_t *frame) {
+  if (len < 1)
+    return 0;
+
+  uint8_t mask = in[0];
+  uint8_t pos = 1;
+  uint16_t next[AS726x_NUM_CHANNELS];
+
+  for (uint8_t i = 0; i < AS726x_NUM_CHANNELS; i++) {
+    int32_t val = (mask & AS726x_DELTA_KEYFRAME) ? 0 : frame[i];
+
+    if (mask & (1 << i)) {
+      uint32_t zz = 0;
+      uint8_t shift = 0;
+      uint8_t b;
+      do {
+        if (pos >= len || shift > 14)
+          return 0;
+        b = in[pos++];
+        zz |= (uint32_t)(b & 0x7F) << shift;
+        shift += 7;
+      } while (b & 0x80);
+      val += (zz & 1) ? -(int32_t)((zz + 1) >> 1) : (int32_t)(zz >> 1);
+    }
+    if (val < 0 || val > 0xFFFF)
+      return 0;
+    next[i] = val;
+  }
+
+  memcpy(frame, next, sizeof(next));
+  return pos;
+}
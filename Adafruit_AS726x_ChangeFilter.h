@@ -0,0 +1,57 @@
+/*!
+ * @file Adafruit_AS726x_ChangeFilter.h
+ *
+ * Change detection and delta encoding of AS726x frames
+ *
+ * Adafruit invests time and resources providing this open source code,
+ * please support Adafruit and open-source hardware by purchasing
+ * products from Adafruit!
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#ifndef LIB_ADAFRUIT_AS726X_CHANGEFILTER
+#define LIB_ADAFRUIT_AS726X_CHANGEFILTER
+
+#include "Adafruit_AS726x.h"
+
+#define AS726x_DELTA_KEYFRAME 0x80 ///< header flag, deltas are from zero
+#define AS726x_DELTA_MAX_LEN (1 + 3 * AS726x_NUM_CHANNELS) ///< max frame bytes
+
+/**************************************************************************/
+/*!
+    @brief  Class that decides which AS726x frames are worth sending on, and
+   encodes them as deltas against the last frame sent
+*/
+/**************************************************************************/
+class Adafruit_AS726x_ChangeFilter {
+public:
+  Adafruit_AS726x_ChangeFilter();
+
+  void setThreshold(uint8_t channel, uint16_t threshold,
+                    uint16_t hysteresis = 0, bool relative = false);
+  void setThresholds(uint16_t threshold, uint16_t hysteresis = 0,
+                     bool relative = false);
+  void reset();
+
+  bool update(const uint16_t *frame);
+  uint8_t encodeDelta(const uint16_t *frame, uint8_t *out);
+  static uint8_t decodeDelta(const uint8_t *in, uint8_t len, uint16_t *frame);
+
+  /*!
+      @brief  Get the last frame that update() let through
+      @return pointer to AS726x_NUM_CHANNELS values
+  */
+  const uint16_t *lastFrame() { return _last; }
+
+private:
+  uint16_t _last[AS726x_NUM_CHANNELS];       ///< last emitted frame
+  uint16_t _threshold[AS726x_NUM_CHANNELS];  ///< per channel change threshold
+  uint16_t _hysteresis[AS726x_NUM_CHANNELS]; ///< threshold drop while active
+  uint8_t _relative; ///< channels whose threshold is relative, one bit each
+  uint8_t _active;   ///< channels that changed in the last emitted frame
+  bool _primed;      ///< true once a frame has been emitted
+};
+
+#endif
@@ -0,0 +1,273 @@
+/*!
+ * @file Adafruit_AS726x_Classifier.cpp
+ *
+ * Matches AS726x frames against a library of reference spectra. References
+ * are stored as Q15 fixed point, AS726x_NUM_CHANNELS words per entry, and may
+ * live in PROGMEM on AVR. Use normalize() with the same metric to build the
+ * reference table.
+ *
+ * Adafruit invests time and resources providing this open source code,
+ * please support Adafruit and open-source hardware by purchasing
+ * products from Adafruit!
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#include "Adafruit_AS726x_Classifier.h"
+
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#define AS726x_READ_REF(p) pgm_read_word(p) ///< reference table is in flash
+#else
+#define AS726x_READ_REF(p) (*(p)) ///< reference table is memory mapped
+#define AS726x_CLASSIFIER_BLOCK 32 ///< references per classifyBatch() pass
+#define AS726x_CLASSIFIER_TILE 16  ///< frames per classifyBatch() pass
+#endif
+
+static uint16_t as726x_isqrt(uint32_t v) {
+  uint32_t res = 0;
+  uint32_t bit = (uint32_t)1 << 30;
+
+  while (bit > v)
+    bit >>= 2;
+  while (bit) {
+    if (v >= res + bit) {
+      v -= res + bit;
+      res = (res >> 1) + bit;
+    } else {
+      res >>= 1;
+    }
+    bit >>= 2;
+  }
+  return res;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Class constructor
+    @param refs reference spectra, AS726x_NUM_CHANNELS Q15 values per entry as
+   produced by normalize(). On AVR the table must be declared PROGMEM.
+    @param numRefs the number of reference spectra
+    @param metric Optional metric the references were normalised for.
+   Defaults to AS726x_MATCH_COSINE
+*/
+/**************************************************************************/
+Adafruit_AS726x_Classifier::Adafruit_AS726x_Classifier(const uint16_t *refs,
+                                                       uint16_t numRefs,
+                                                       uint8_t metric) {
+  _refs = refs;
+  _num_refs = numRefs;
+  _metric = metric;
+}
+
+/**************************************************************************/
+/*!
+    @brief  normalise a raw frame to Q15. AS726x_MATCH_EUCLIDEAN scales the
+   channels to sum to AS726x_CLASSIFIER_SCALE, AS726x_MATCH_COSINE scales
+   them to a length of AS726x_CLASSIFIER_SCALE.
+    @param frame AS726x_NUM_CHANNELS raw values, as from readRawValues()
+    @param out buffer for the AS726x_NUM_CHANNELS normalised values
+    @param metric Optional metric to normalise for. Defaults to
+   AS726x_MATCH_COSINE
+*/
+/**************************************************************************/
+void Adafruit_AS726x_Classifier::normalize(const uint16_t *frame,
+                                           uint16_t *out, uint8_t metric) {
+  uint16_t v[AS726x_NUM_CHANNELS];
+  uint16_t max = 0;
+  uint32_t norm = 0;
+
+  for (uint8_t i = 0; i < AS726x_NUM_CHANNELS; i++)
+    if (frame[i] > max)
+      max = frame[i];
+
+  // keep the sum of squares within 32 bits
+  uint8_t shift = 0;
+  if (metric == AS726x_MATCH_COSINE)
+    while ((max >> shift) >= 0x4000)
+      shift++;
+
+  for (uint8_t i = 0; i < AS726x_NUM_CHANNELS; i++) {
+    v[i] = frame[i] >> shift;
+    if (metric == AS726x_MATCH_COSINE)
+      norm += (uint32_t)v[i] * v[i];
+    else
+      norm += v[i];
+  }
+  if (metric == AS726x_MATCH_COSINE)
+    norm = as726x_isqrt(norm);
+
+  for (uint8_t i = 0; i < AS726x_NUM_CHANNELS; i++)
+    out[i] = norm ? ((uint32_t)v[i] * AS726x_CLASSIFIER_SCALE + (norm >> 1)) /
+                        norm
+                  : 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  normalise a calibrated frame to Q15. Negative values are treated
+   as zero.
+    @param frame AS726x_NUM_CHANNELS calibrated values, as from
+   readCalibratedValues()
+    @param out buffer for the AS726x_NUM_CHANNELS normalised values
+    @param metric Optional metric to normalise for. Defaults to
+   AS726x_MATCH_COSINE
+*/
+/**************************************************************************/
+void Adafruit_AS726x_Classifier::normalize(const float *frame, uint16_t *out,
+                                           uint8_t metric) {
+  float norm = 0;
+
+  for (uint8_t i = 0; i < AS726x_NUM_CHANNELS; i++) {
+    float v = frame[i] > 0 ? frame[i] : 0;
+    norm += (metric == AS726x_MATCH_COSINE) ? v * v : v;
+  }
+  if (metric == AS726x_MATCH_COSINE)
+    norm = sqrt(norm);
+
+  for (uint8_t i = 0; i < AS726x_NUM_CHANNELS; i++)
+    out[i] = (norm > 0 && frame[i] > 0)
+                 ? (uint16_t)(frame[i] / norm * AS726x_CLASSIFIER_SCALE + 0.5f)
+                 : 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  find the reference spectrum closest to a raw frame
+    @param frame AS726x_NUM_CHANNELS raw values, as from readRawValues()
+    @param distance Optional pointer to store the squared Q15 distance to the
+   match in. For AS726x_MATCH_COSINE the cosine similarity is
+   1 - distance / 2^31.
+    @return the index of the closest reference, or -1 if there are none
+*/
+/**************************************************************************/
+int16_t Adafruit_AS726x_Classifier::classify(const uint16_t *frame,
+                                             uint32_t *distance) {
+  uint16_t norm[AS726x_NUM_CHANNELS];
+  normalize(frame, norm, _metric);
+  return search(norm, distance);
+}
+
+/**************************************************************************/
+/*!
+    @brief  find the reference spectrum closest to a calibrated frame
+    @param frame AS726x_NUM_CHANNELS calibrated values, as from
+   readCalibratedValues()
+    @param distance Optional pointer to store the squared Q15 distance to the
+   match in
+    @return the index of the closest reference, or -1 if there are none
+*/
+/**************************************************************************/
+int16_t Adafruit_AS726x_Classifier::classify(const float *frame,
+                                             uint32_t *distance) {
+  uint16_t norm[AS726x_NUM_CHANNELS];
+  normalize(frame, norm, _metric);
+  return search(norm, distance);
+}
+
+/**************************************************************************/
+/*!
+    @brief  classify a batch of raw frames. On AVR each frame goes through the
+   early terminating search. Elsewhere frames are normalised once each, a
+   tile of AS726x_CLASSIFIER_TILE at a time, and the references are copied a
+   block at a time into a channel-major buffer shared by the whole tile. The
+   distances to a block are computed by one branch free loop the compiler can
+   vectorise, and the closest is picked in a second pass. Each block is
+   copied once per tile.
+    @param frames num frames of AS726x_NUM_CHANNELS raw values each
+    @param num the number of frames
+    @param classes buffer for the num indices of the closest references
+    @param distances Optional buffer for the num squared Q15 distances
+*/
+/**************************************************************************/
+void Adafruit_AS726x_Classifier::classifyBatch(const uint16_t *frames,
+                                               uint16_t num, int16_t *classes,
+                                               uint32_t *distances) {
+#ifdef __AVR__
+  uint16_t norm[AS726x_NUM_CHANNELS];
+
+  for (uint16_t f = 0; f < num; f++) {
+    normalize(frames + f * AS726x_NUM_CHANNELS, norm, _metric);
+    classes[f] = search(norm, distances ? distances + f : NULL);
+  }
+#else
+  uint16_t norm[AS726x_CLASSIFIER_TILE][AS726x_NUM_CHANNELS];
+  uint32_t best_dist[AS726x_CLASSIFIER_TILE];
+  uint16_t block[AS726x_NUM_CHANNELS][AS726x_CLASSIFIER_BLOCK];
+  uint32_t dist[AS726x_CLASSIFIER_BLOCK];
+
+  for (uint16_t tile = 0; tile < num; tile += AS726x_CLASSIFIER_TILE) {
+    uint16_t frame_count = num - tile;
+    if (frame_count > AS726x_CLASSIFIER_TILE)
+      frame_count = AS726x_CLASSIFIER_TILE;
+
+    for (uint16_t f = 0; f < frame_count; f++) {
+      normalize(frames + (tile + f) * AS726x_NUM_CHANNELS, norm[f], _metric);
+      classes[tile + f] = -1;
+      best_dist[f] = 0xFFFFFFFF;
+    }
+
+    for (uint16_t base = 0; base < _num_refs; base += AS726x_CLASSIFIER_BLOCK) {
+      uint16_t count = _num_refs - base;
+      if (count > AS726x_CLASSIFIER_BLOCK)
+        count = AS726x_CLASSIFIER_BLOCK;
+
+      const uint16_t *ref = _refs + base * AS726x_NUM_CHANNELS;
+      for (uint16_t r = 0; r < count; r++, ref += AS726x_NUM_CHANNELS)
+        for (uint8_t i = 0; i < AS726x_NUM_CHANNELS; i++)
+          block[i][r] = ref[i];
+
+      for (uint16_t f = 0; f < frame_count; f++) {
+        for (uint16_t r = 0; r < count; r++)
+          dist[r] = 0;
+        for (uint8_t i = 0; i < AS726x_NUM_CHANNELS; i++) {
+          int32_t v = norm[f][i];
+          for (uint16_t r = 0; r < count; r++) {
+            int32_t diff = v - block[i][r];
+            dist[r] += (uint32_t)(diff * diff);
+          }
+        }
+
+        for (uint16_t r = 0; r < count; r++) {
+          if (dist[r] < best_dist[f]) {
+            best_dist[f] = dist[r];
+            classes[tile + f] = base + r;
+          }
+        }
+      }
+    }
+
+    if (distances)
+      memcpy(distances + tile, best_dist, frame_count * sizeof(uint32_t));
+  }
+#endif
+}
+
+// nearest-neighbour search that abandons a reference as soon as its partial
+// distance reaches the best found so far
+int16_t Adafruit_AS726x_Classifier::search(const uint16_t *norm,
+                                           uint32_t *distance) {
+  int16_t best = -1;
+  uint32_t best_dist = 0xFFFFFFFF;
+  const uint16_t *ref = _refs;
+
+  for (uint16_t r = 0; r < _num_refs; r++, ref += AS726x_NUM_CHANNELS) {
+    uint32_t d = 0;
+    uint8_t i;
+    for (i = 0; i < AS726x_NUM_CHANNELS; i++) {
+      int32_t diff = (int32_t)norm[i] - (int32_t)AS726x_READ_REF(ref + i);
+      d += (uint32_t)(diff * diff);
+      if (d >= best_dist)
+        break;
+    }
+    if (i == AS726x_NUM_CHANNELS) {
+      best_dist = d;
+      best = r;
+    }
+  }
+
+  if (distance)
+    *distance = best_dist;
+  return best;
+}
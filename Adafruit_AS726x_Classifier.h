@@ -0,0 +1,61 @@
+/*!
+ * @file Adafruit_AS726x_Classifier.h
+ *
+ * Nearest-neighbour spectral classifier for the Adafruit AS726x library
+ *
+ * Adafruit invests time and resources providing this open source code,
+ * please support Adafruit and open-source hardware by purchasing
+ * products from Adafruit!
+ *
+ * BSD license, all text here must be included in any redistribution.
+ *
+ */
+
+#ifndef LIB_ADAFRUIT_AS726X_CLASSIFIER
+#define LIB_ADAFRUIT_AS726X_CLASSIFIER
+
+#include "Adafruit_AS726x.h"
+
+#define AS726x_CLASSIFIER_SCALE 32767 ///< Q15 full scale of normalised spectra
+
+/**************************************************************************/
+/*!
+    @brief  metrics used to compare a frame with the reference spectra
+*/
+/**************************************************************************/
+enum as726x_match_metric {
+  AS726x_MATCH_EUCLIDEAN, ///< spectra normalised to unit sum, L2 distance
+  AS726x_MATCH_COSINE,    ///< spectra normalised to unit length, ranks by
+                          ///< cosine similarity
+};
+
+/**************************************************************************/
+/*!
+    @brief  Class that matches AS726x frames against a library of normalised
+   reference spectra
+*/
+/**************************************************************************/
+class Adafruit_AS726x_Classifier {
+public:
+  Adafruit_AS726x_Classifier(const uint16_t *refs, uint16_t numRefs,
+                             uint8_t metric = AS726x_MATCH_COSINE);
+
+  static void normalize(const uint16_t *frame, uint16_t *out,
+                        uint8_t metric = AS726x_MATCH_COSINE);
+  static void normalize(const float *frame, uint16_t *out,
+                        uint8_t metric = AS726x_MATCH_COSINE);
+
+  int16_t classify(const uint16_t *frame, uint32_t *distance = NULL);
+  int16_t classify(const float *frame, uint32_t *distance = NULL);
+  void classifyBatch(const uint16_t *frames, uint16_t num, int16_t *classes,
+                     uint32_t *distances = NULL);
+
+private:
+  const uint16_t *_refs; ///< reference spectra, AS726x_NUM_CHANNELS per entry
+  uint16_t _num_refs;    ///< number of reference spectra
+  uint8_t _metric;       ///< metric the references were normalised for
+
+  int16_t search(const uint16_t *norm, uint32_t *distance);
+};
+
+#endif
@@ -0,0 +1,98 @@
+/*!
+ * @file bus_lock_stress.cpp
+ *
+ * Stress test for setBusLock(). Two threads share the emulated sensor
+ * through separate driver instances guarded by one std::mutex, and check
+ * every value they read or write. Throughput is reported for one thread
+ * alone and for both under contention.
+ *
+ * Usage: bus_lock_stress [iterations per thread]
+ *
+ */
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+
+#include "Adafruit_AS726x.h"
+#include "emulated_as726x.h"
+
+static std::mutex bus_mutex;
+static std::atomic<unsigned long> corrupted(0);
+
+static void bus_lock(void *ctx) { static_cast<std::mutex *>(ctx)->lock(); }
+
+static void bus_unlock(void *ctx) { static_cast<std::mutex *>(ctx)->unlock(); }
+
+// one exchange per iteration
+static unsigned long read_temperature(Adafruit_AS726x &sensor,
+                                      unsigned long iterations) {
+  for (unsigned long i = 0; i < iterations; i++) {
+    if (sensor.readTemperature() != EMU_TEMPERATURE)
+      corrupted++;
+  }
+  return iterations;
+}
+
+// three exchanges per iteration, one write and two reads. Nothing else may
+// write the integration time while this runs.
+static unsigned long write_and_read(Adafruit_AS726x &sensor,
+                                    unsigned long iterations) {
+  for (unsigned long i = 0; i < iterations; i++) {
+    uint8_t time = i & 0xFF;
+    sensor.setIntegrationTime(time);
+    if (as726x_emulator.peek(AS726X_INT_T) != time)
+      corrupted++;
+    if (sensor.readViolet() != EMU_VIOLET)
+      corrupted++;
+  }
+  return 3 * iterations;
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+int main(int argc, char **argv) {
+  unsigned long iterations = argc > 1 ? strtoul(argv[1], NULL, 0) : 100000;
+
+  // begin() writes the integration time, so both sensors are set up before
+  // the threads start rather than racing write_and_read()'s checks
+  Adafruit_AS726x sensor_a, sensor_b;
+  sensor_a.setBusLock(bus_lock, bus_unlock, &bus_mutex);
+  sensor_b.setBusLock(bus_lock, bus_unlock, &bus_mutex);
+  if (!sensor_a.begin() || !sensor_b.begin()) {
+    printf("begin() failed\n");
+    return 1;
+  }
+
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  unsigned long exchanges = read_temperature(sensor_a, iterations);
+  exchanges += write_and_read(sensor_b, iterations);
+  double elapsed = seconds_since(start);
+  printf("single thread: %lu exchanges in %.3f s, %.0f exchanges/s\n",
+         exchanges, elapsed, exchanges / elapsed);
+
+  unsigned long exchanges_a = 0, exchanges_b = 0;
+  start = std::chrono::steady_clock::now();
+  std::thread a([&] { exchanges_a = read_temperature(sensor_a, iterations); });
+  std::thread b([&] { exchanges_b = write_and_read(sensor_b, iterations); });
+  a.join();
+  b.join();
+  elapsed = seconds_since(start);
+  exchanges = exchanges_a + exchanges_b;
+  printf("two threads:   %lu exchanges in %.3f s, %.0f exchanges/s\n",
+         exchanges, elapsed, exchanges / elapsed);
+
+  unsigned long errors = as726x_emulator.protocol_errors;
+  printf("corrupted values: %lu, protocol errors: %lu\n", corrupted.load(),
+         errors);
+
+  return (corrupted || errors) ? 1 : 0;
+}
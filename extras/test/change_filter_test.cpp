@@ -0,0 +1,136 @@
+/*!
+ * @file change_filter_test.cpp
+ *
+ * Round-trips frames through encodeDelta() and decodeDelta() over random
+ * walks and full-scale jumps, and checks threshold, hysteresis and
+ * relative threshold behaviour of update().
+ *
+ */
+
+#include <stdlib.h>
+
+#include "Adafruit_AS726x_ChangeFilter.h"
+#include "test_util.h"
+
+static uint16_t clamp(int32_t v) {
+  return v < 0 ? 0 : (v > 0xFFFF ? 0xFFFF : v);
+}
+
+// encode each frame, decode what was emitted and compare with lastFrame()
+static void round_trip(Adafruit_AS726x_ChangeFilter &filter,
+                       const uint16_t *frame, uint16_t *decoded,
+                       unsigned long *emitted) {
+  uint8_t out[AS726x_DELTA_MAX_LEN + 1];
+  out[AS726x_DELTA_MAX_LEN] = 0xA5;
+
+  uint8_t len = filter.encodeDelta(frame, out);
+  CHECK(len <= AS726x_DELTA_MAX_LEN);
+  CHECK(out[AS726x_DELTA_MAX_LEN] == 0xA5);
+  if (!len)
+    return;
+
+  const size_t size = sizeof(uint16_t) * AS726x_NUM_CHANNELS;
+  (*emitted)++;
+  CHECK(Adafruit_AS726x_ChangeFilter::decodeDelta(out, len, decoded) == len);
+  CHECK(memcmp(decoded, filter.lastFrame(), size) == 0);
+  CHECK(memcmp(decoded, frame, size) == 0);
+}
+
+static void test_random_walk() {
+  Adafruit_AS726x_ChangeFilter filter;
+  uint16_t frame[AS726x_NUM_CHANNELS] = {1000, 2000, 30000, 0, 500, 65535};
+  uint16_t decoded[AS726x_NUM_CHANNELS] = {0};
+  unsigned long emitted = 0;
+
+  filter.setThresholds(20, 10);
+  for (uint32_t n = 0; n < 100000; n++) {
+    for (uint8_t i = 0; i < AS726x_NUM_CHANNELS; i++)
+      frame[i] = clamp((int32_t)frame[i] + rand() % 21 - 10);
+    round_trip(filter, frame, decoded, &emitted);
+  }
+  printf("random walk: %lu of 100000 frames emitted\n", emitted);
+  CHECK(emitted > 0 && emitted < 100000);
+}
+
+static void test_large_jumps() {
+  Adafruit_AS726x_ChangeFilter filter;
+  uint16_t frame[AS726x_NUM_CHANNELS];
+  uint16_t decoded[AS726x_NUM_CHANNELS] = {0};
+  unsigned long emitted = 0;
+
+  // full-scale swings need the longest varints
+  for (uint32_t n = 0; n < 10000; n++) {
+    for (uint8_t i = 0; i < AS726x_NUM_CHANNELS; i++)
+      frame[i] = (n + i) & 1 ? 0xFFFF : (rand() % 4 ? 0 : rand() % 0x10000);
+    round_trip(filter, frame, decoded, &emitted);
+  }
+  CHECK(emitted > 0);
+
+  // a full swing on every channel is the largest encoding
+  uint8_t out[AS726x_DELTA_MAX_LEN];
+  uint16_t low[AS726x_NUM_CHANNELS] = {0};
+  uint16_t high[AS726x_NUM_CHANNELS];
+  for (uint8_t i = 0; i < AS726x_NUM_CHANNELS; i++)
+    high[i] = 0xFFFF;
+  filter.reset();
+  CHECK(filter.encodeDelta(high, out) == AS726x_DELTA_MAX_LEN);
+  CHECK(filter.encodeDelta(low, out) == AS726x_DELTA_MAX_LEN);
+
+  // truncated input is rejected and leaves the frame alone
+  memcpy(decoded, high, sizeof(decoded));
+  CHECK(Adafruit_AS726x_ChangeFilter::decodeDelta(out, 5, decoded) == 0);
+  CHECK(memcmp(decoded, high, sizeof(decoded)) == 0);
+}
+
+static void test_thresholds() {
+  Adafruit_AS726x_ChangeFilter filter;
+  uint16_t frame[AS726x_NUM_CHANNELS] = {1000, 1000, 1000, 1000, 1000, 1000};
+
+  filter.setThresholds(100, 50);
+  CHECK(filter.update(frame)); // first frame always goes out
+  frame[0] = 1100;
+  CHECK(!filter.update(frame)); // not more than the threshold
+  frame[0] = 1101;
+  CHECK(filter.update(frame)); // past it, channel 0 is now active
+  frame[0] = 1152;
+  CHECK(filter.update(frame)); // active, so threshold - hysteresis applies
+  frame[0] = 1200;
+  CHECK(!filter.update(frame)); // steady, channel 0 goes quiet
+  frame[0] = 1251;
+  CHECK(!filter.update(frame)); // quiet needs the full threshold again
+}
+
+static void test_relative_threshold_over_100_percent() {
+  Adafruit_AS726x_ChangeFilter filter;
+  uint16_t frame[AS726x_NUM_CHANNELS] = {40000, 40000, 40000,
+                                         40000, 40000, 40000};
+
+  // 2048/1024 allows a 200% change, so nothing in 16 bits can exceed it
+  filter.setThresholds(2048, 0, true);
+  CHECK(filter.update(frame));
+  for (uint8_t i = 0; i < AS726x_NUM_CHANNELS; i++)
+    frame[i] = 60000;
+  CHECK(!filter.update(frame));
+  for (uint8_t i = 0; i < AS726x_NUM_CHANNELS; i++)
+    frame[i] = 0;
+  CHECK(!filter.update(frame));
+
+  // 512/1024 is 50% of the last emitted value
+  filter.setThresholds(512, 0, true);
+  frame[0] = 40000;
+  CHECK(filter.update(frame));
+  frame[0] = 60000;
+  CHECK(!filter.update(frame));
+  frame[0] = 60001;
+  CHECK(filter.update(frame));
+}
+
+int main() {
+  srand(1);
+  test_random_walk();
+  test_large_jumps();
+  test_thresholds();
+  test_relative_threshold_over_100_percent();
+
+  return test_summary("change_filter_test");
+}
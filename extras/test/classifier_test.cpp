@@ -0,0 +1,87 @@
+/*!
+ * @file classifier_test.cpp
+ *
+ * Checks that classifyBatch(), which takes the vectorised path on the host,
+ * agrees exactly with classify() for both metrics and for reference counts
+ * that do and do not fill whole blocks, and times the two.
+ *
+ */
+
+#include <chrono>
+#include <stdlib.h>
+
+#include "Adafruit_AS726x_Classifier.h"
+#include "test_util.h"
+
+#define NUM_FRAMES 5000 ///< frames classified per case
+#define MAX_REFS 200    ///< largest reference library tested
+
+static uint16_t refs[MAX_REFS * AS726x_NUM_CHANNELS];
+static uint16_t frames[NUM_FRAMES * AS726x_NUM_CHANNELS];
+static int16_t classes[NUM_FRAMES];
+static uint32_t distances[NUM_FRAMES];
+
+static double ms_since(std::chrono::steady_clock::time_point start) {
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+static void test_batch_matches_single(uint8_t metric, uint16_t num_refs) {
+  for (uint16_t r = 0; r < num_refs; r++) {
+    uint16_t raw[AS726x_NUM_CHANNELS];
+    for (uint8_t i = 0; i < AS726x_NUM_CHANNELS; i++)
+      raw[i] = rand() % 60000 + 1;
+    Adafruit_AS726x_Classifier::normalize(raw, refs + r * AS726x_NUM_CHANNELS,
+                                          metric);
+  }
+  for (uint32_t i = 0; i < NUM_FRAMES * AS726x_NUM_CHANNELS; i++)
+    frames[i] = rand() % 0x10000;
+
+  Adafruit_AS726x_Classifier classifier(refs, num_refs, metric);
+
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  classifier.classifyBatch(frames, NUM_FRAMES, classes, distances);
+  double batch_ms = ms_since(start);
+
+  unsigned long mismatches = 0;
+  start = std::chrono::steady_clock::now();
+  for (uint16_t f = 0; f < NUM_FRAMES; f++) {
+    uint32_t distance;
+    int16_t match =
+        classifier.classify(frames + f * AS726x_NUM_CHANNELS, &distance);
+    if (match != classes[f] || distance != distances[f])
+      mismatches++;
+  }
+  double single_ms = ms_since(start);
+
+  printf("metric %u, %u refs: %lu mismatches, batch %.1f ms, single %.1f ms\n",
+         metric, num_refs, mismatches, batch_ms, single_ms);
+  CHECK(mismatches == 0);
+
+  // classes alone, without distances
+  int16_t first = classes[0];
+  classifier.classifyBatch(frames, 1, classes, NULL);
+  CHECK(classes[0] == first);
+}
+
+int main() {
+  const uint16_t ref_counts[] = {1, 31, 32, 33, MAX_REFS};
+
+  srand(1);
+  for (uint8_t metric = AS726x_MATCH_EUCLIDEAN; metric <= AS726x_MATCH_COSINE;
+       metric++)
+    for (uint8_t n = 0; n < sizeof(ref_counts) / sizeof(ref_counts[0]); n++)
+      test_batch_matches_single(metric, ref_counts[n]);
+
+  // an empty library matches nothing
+  Adafruit_AS726x_Classifier empty(refs, 0);
+  classes[0] = 0;
+  distances[0] = 0;
+  empty.classifyBatch(frames, 1, classes, distances);
+  CHECK(classes[0] == -1);
+  CHECK(distances[0] == 0xFFFFFFFF);
+
+  return test_summary("classifier_test");
+}
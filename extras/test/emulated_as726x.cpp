@@ -0,0 +1,109 @@
+/*!
+ * @file emulated_as726x.cpp
+ *
+ * Emulation of the AS726x I2C slave interface. A write to the write register
+ * holds TX_VALID until the host next polls the status register, and a
+ * virtual register read raises RX_VALID until the read register is read.
+ * Any transaction the real slave would not accept is counted as a protocol
+ * error. Conversions complete as soon as they are started.
+ *
+ */
+
+#include "emulated_as726x.h"
+#include "Adafruit_AS726x.h"
+
+TwoWire Wire;
+EmulatedAS726x as726x_emulator;
+
+// channel gain of each channel_gain setting, in tenths
+static const uint32_t emu_gain_x10[] = {10, 37, 160, 640};
+
+EmulatedAS726x::EmulatedAS726x() : protocol_errors(0), control_writes(0) {
+  memset(_vregs, 0, sizeof(_vregs));
+  _vregs[AS726X_HW_VERSION] = EMU_HW_VERSION;
+  _vregs[AS726X_DEVICE_TEMP] = EMU_TEMPERATURE;
+  _vregs[AS7262_V_HIGH] = EMU_VIOLET >> 8;
+  _vregs[AS7262_V_LOW] = EMU_VIOLET & 0xFF;
+  _status = 0;
+  _rx = 0;
+  _pending_write = -1;
+  _has_scene = false;
+}
+
+uint8_t EmulatedAS726x::readReg(uint8_t reg) {
+  std::lock_guard<std::mutex> guard(_bus);
+  uint8_t ret;
+
+  switch (reg) {
+  case AS726X_SLAVE_STATUS_REG:
+    ret = _status;
+    // the slave takes the written byte by the time the host polls again
+    _status &= ~AS726X_SLAVE_TX_VALID;
+    return ret;
+  case AS726X_SLAVE_READ_REG:
+    if (!(_status & AS726X_SLAVE_RX_VALID))
+      protocol_errors++;
+    _status &= ~AS726X_SLAVE_RX_VALID;
+    return _rx;
+  default:
+    protocol_errors++;
+    return 0;
+  }
+}
+
+void EmulatedAS726x::writeReg(uint8_t reg, uint8_t value) {
+  std::lock_guard<std::mutex> guard(_bus);
+
+  if (reg != AS726X_SLAVE_WRITE_REG || (_status & AS726X_SLAVE_TX_VALID)) {
+    protocol_errors++;
+    return;
+  }
+  _status |= AS726X_SLAVE_TX_VALID;
+
+  if (_pending_write >= 0) {
+    // data byte of a virtual register write
+    _vregs[_pending_write] = value;
+    if (_pending_write == AS726X_CONTROL_SETUP) {
+      control_writes++;
+      if (((value >> 2) & 0x03) == ONE_SHOT)
+        convert();
+    }
+    _pending_write = -1;
+  } else if (value & 0x80) {
+    // address byte of a virtual register write
+    _pending_write = (value & 0x7F) % EMU_NUM_VREGS;
+  } else {
+    // address byte of a virtual register read
+    if (_status & AS726X_SLAVE_RX_VALID)
+      protocol_errors++;
+    _rx = _vregs[value % EMU_NUM_VREGS];
+    _status |= AS726X_SLAVE_RX_VALID;
+  }
+}
+
+uint8_t EmulatedAS726x::peek(uint8_t vreg) {
+  std::lock_guard<std::mutex> guard(_bus);
+  return _vregs[vreg % EMU_NUM_VREGS];
+}
+
+void EmulatedAS726x::setScene(const uint32_t *scene) {
+  std::lock_guard<std::mutex> guard(_bus);
+  memcpy(_scene, scene, sizeof(_scene));
+  _has_scene = true;
+}
+
+// runs with _bus held, from the CONTROL_SETUP write that starts a ONE_SHOT
+void EmulatedAS726x::convert() {
+  if (!_has_scene)
+    return;
+
+  uint32_t gain = emu_gain_x10[(_vregs[AS726X_CONTROL_SETUP] >> 4) & 0x03];
+  for (uint8_t i = 0; i < EMU_NUM_CHANNELS; i++) {
+    uint32_t raw = _scene[i] * gain / emu_gain_x10[GAIN_64X];
+    if (raw > 0xFFFF)
+      raw = 0xFFFF;
+    _vregs[AS7262_V_HIGH + 2 * i] = raw >> 8;
+    _vregs[AS7262_V_LOW + 2 * i] = raw & 0xFF;
+  }
+  _vregs[AS726X_CONTROL_SETUP] |= 0x02;
+}
@@ -0,0 +1,95 @@
+/*!
+ * @file hdr_test.cpp
+ *
+ * Tests readHDRValues() against emulated scenes. A dim scene must cost a
+ * single conversion, a bright one must fall back to lower gains for the
+ * saturated channels only, and every result must be in GAIN_64X counts.
+ *
+ */
+
+#include "Adafruit_AS726x.h"
+#include "emulated_as726x.h"
+#include "test_util.h"
+
+// channel gain of each channel_gain setting, in tenths
+static const uint32_t gain_x10[] = {10, 37, 160, 640};
+
+// what readHDRValues() should report for a level first unsaturated at gain
+static uint32_t expected(uint32_t level, uint8_t gain) {
+  uint32_t raw = level * gain_x10[gain] / gain_x10[GAIN_64X];
+  if (raw > AS726x_SATURATION)
+    raw = AS726x_SATURATION;
+  return (raw * gain_x10[GAIN_64X] + gain_x10[gain] / 2) / gain_x10[gain];
+}
+
+static void test_dim_scene(Adafruit_AS726x &sensor) {
+  const uint32_t scene[EMU_NUM_CHANNELS] = {10, 100, 1000, 10000, 30000,
+                                            65534};
+  uint32_t hdr[AS726x_NUM_CHANNELS];
+
+  as726x_emulator.setScene(scene);
+  as726x_emulator.control_writes = 0;
+  CHECK(sensor.readHDRValues(hdr));
+  CHECK(as726x_emulator.control_writes == 1);
+  for (uint8_t i = 0; i < AS726x_NUM_CHANNELS; i++)
+    CHECK(hdr[i] == scene[i]);
+}
+
+static void test_bright_scene(Adafruit_AS726x &sensor) {
+  // unsaturated at 64X, 16X, 3.7X, 1X, 1X and 16X respectively
+  const uint32_t scene[EMU_NUM_CHANNELS] = {500,     100000,  1000000,
+                                            3000000, 4000000, 200000};
+  const uint8_t gain[EMU_NUM_CHANNELS] = {GAIN_64X, GAIN_16X, GAIN_3X7,
+                                          GAIN_1X,  GAIN_1X,  GAIN_16X};
+  uint32_t hdr[AS726x_NUM_CHANNELS];
+
+  as726x_emulator.setScene(scene);
+  as726x_emulator.control_writes = 0;
+  CHECK(sensor.readHDRValues(hdr));
+  CHECK(as726x_emulator.control_writes == 4);
+  for (uint8_t i = 0; i < AS726x_NUM_CHANNELS; i++) {
+    CHECK(hdr[i] == expected(scene[i], gain[i]));
+    // fused values stay within the rounding of the gain they came from
+    uint32_t err = hdr[i] > scene[i] ? hdr[i] - scene[i] : scene[i] - hdr[i];
+    CHECK(err * gain_x10[gain[i]] <= 2 * gain_x10[GAIN_64X]);
+  }
+}
+
+static void test_gain_mask(Adafruit_AS726x &sensor) {
+  const uint32_t scene[EMU_NUM_CHANNELS] = {500,    100000, 1000000,
+                                            500000, 200,    200000};
+  uint32_t hdr[AS726x_NUM_CHANNELS];
+
+  // only 64X and 1X, so the channels saturated at 64X go straight to 1X
+  as726x_emulator.setScene(scene);
+  as726x_emulator.control_writes = 0;
+  CHECK(sensor.readHDRValues(hdr, (1 << GAIN_64X) | (1 << GAIN_1X)));
+  CHECK(as726x_emulator.control_writes == 2);
+  CHECK(hdr[0] == scene[0]);
+  CHECK(hdr[1] == expected(scene[1], GAIN_1X));
+  CHECK(hdr[2] == expected(scene[2], GAIN_1X));
+
+  // saturated even at the lowest gain selected
+  as726x_emulator.control_writes = 0;
+  CHECK(!sensor.readHDRValues(hdr, 1 << GAIN_64X));
+  CHECK(as726x_emulator.control_writes == 1);
+  CHECK(hdr[1] == expected(scene[1], GAIN_64X));
+
+  // no gain selected, nothing is touched
+  as726x_emulator.control_writes = 0;
+  hdr[0] = 0xDEADBEEF;
+  CHECK(!sensor.readHDRValues(hdr, 0));
+  CHECK(as726x_emulator.control_writes == 0);
+  CHECK(hdr[0] == 0xDEADBEEF);
+}
+
+int main() {
+  Adafruit_AS726x sensor;
+  CHECK(sensor.begin());
+
+  test_dim_scene(sensor);
+  test_bright_scene(sensor);
+  test_gain_mask(sensor);
+
+  return test_summary("hdr_test");
+}
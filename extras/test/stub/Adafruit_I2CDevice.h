@@ -0,0 +1,72 @@
+/*!
+ * @file Adafruit_I2CDevice.h
+ *
+ * Host stand-in for Adafruit BusIO that routes every transaction to the
+ * emulated sensor
+ *
+ */
+
+#ifndef AS726X_TEST_I2CDEVICE_H
+#define AS726X_TEST_I2CDEVICE_H
+
+#include "Arduino.h"
+#include "Wire.h"
+#include "emulated_as726x.h"
+
+/*!
+    @brief  I2C device that talks to as726x_emulator
+*/
+class Adafruit_I2CDevice {
+public:
+  /*!
+      @brief  Class constructor
+      @param addr ignored, there is only one emulated device
+      @param theWire ignored
+  */
+  Adafruit_I2CDevice(uint8_t addr, TwoWire *theWire) {
+    (void)addr;
+    (void)theWire;
+  }
+
+  /*!
+      @brief  Start talking to the device
+      @return always true
+  */
+  bool begin() { return true; }
+
+  /*!
+      @brief  Read one register
+      @param write_buffer the register address
+      @param write_len must be 1
+      @param read_buffer buffer for the register value
+      @param read_len must be 1
+      @return true on success, false otherwise.
+  */
+  bool write_then_read(const uint8_t *write_buffer, size_t write_len,
+                       uint8_t *read_buffer, size_t read_len) {
+    if (write_len != 1 || read_len != 1)
+      return false;
+    read_buffer[0] = as726x_emulator.readReg(write_buffer[0]);
+    return true;
+  }
+
+  /*!
+      @brief  Write one register
+      @param buffer the register value
+      @param len must be 1
+      @param stop ignored
+      @param prefix_buffer the register address
+      @param prefix_len must be 1
+      @return true on success, false otherwise.
+  */
+  bool write(const uint8_t *buffer, size_t len, bool stop = true,
+             const uint8_t *prefix_buffer = NULL, size_t prefix_len = 0) {
+    (void)stop;
+    if (len != 1 || prefix_len != 1)
+      return false;
+    as726x_emulator.writeReg(prefix_buffer[0], buffer[0]);
+    return true;
+  }
+};
+
+#endif
@@ -0,0 +1,25 @@
+/*!
+ * @file Arduino.h
+ *
+ * Minimal host stand-in for the Arduino core, enough to build the driver
+ * against the emulated sensor in emulated_as726x.h
+ *
+ */
+
+#ifndef AS726X_TEST_ARDUINO_H
+#define AS726X_TEST_ARDUINO_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef uint8_t byte; ///< Arduino byte type
+typedef bool boolean; ///< Arduino boolean type
+
+/*!
+    @brief  Does nothing, the emulated sensor never needs waiting for
+*/
+inline void delay(unsigned long) {}
+
+#endif
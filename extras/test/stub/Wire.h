@@ -0,0 +1,18 @@
+/*!
+ * @file Wire.h
+ *
+ * Host stand-in for the Arduino Wire library
+ *
+ */
+
+#ifndef AS726X_TEST_WIRE_H
+#define AS726X_TEST_WIRE_H
+
+/*!
+    @brief  Placeholder for the Arduino I2C bus class
+*/
+class TwoWire {};
+
+extern TwoWire Wire; ///< the default I2C bus
+
+#endif
@@ -0,0 +1,78 @@
+/*!
+ * @file emulated_as726x.h
+ *
+ * Emulation of the AS726x I2C slave interface. Each register transaction is
+ * atomic, as on a real bus, but a virtual register exchange takes several
+ * transactions, so unsynchronised callers can interleave inside one. Once a
+ * scene is set, a ONE_SHOT conversion fills the channel registers from it at
+ * the gain in CONTROL_SETUP and raises DATA_RDY.
+ *
+ */
+
+#ifndef AS726X_TEST_EMULATED_AS726X_H
+#define AS726X_TEST_EMULATED_AS726X_H
+
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+
+#define EMU_HW_VERSION 0x40 ///< AS726X_HW_VERSION reported by the emulator
+#define EMU_TEMPERATURE 25  ///< AS726X_DEVICE_TEMP reported by the emulator
+#define EMU_VIOLET 0x1234   ///< raw violet reading reported by the emulator
+#define EMU_NUM_VREGS 0x40  ///< number of emulated virtual registers
+#define EMU_NUM_CHANNELS 6  ///< number of emulated sensor channels
+
+/*!
+    @brief  Emulated AS726x slave interface shared by every driver instance
+*/
+class EmulatedAS726x {
+public:
+  /*!
+      @brief  Class constructor, sets up the fixed register contents
+  */
+  EmulatedAS726x();
+
+  /*!
+      @brief  Read a hardware register in one bus transaction
+      @param reg the hardware register
+      @return the register value
+  */
+  uint8_t readReg(uint8_t reg);
+  /*!
+      @brief  Write a hardware register in one bus transaction
+      @param reg the hardware register
+      @param value the value to write
+  */
+  void writeReg(uint8_t reg, uint8_t value);
+  /*!
+      @brief  Read a virtual register directly, bypassing the handshake
+      @param vreg the virtual register
+      @return the register value
+  */
+  uint8_t peek(uint8_t vreg);
+  /*!
+      @brief  Set the light level conversions report from now on
+      @param scene EMU_NUM_CHANNELS levels in GAIN_64X counts. Each channel
+     reads as level * gain / 64, saturating at 0xFFFF.
+  */
+  void setScene(const uint32_t *scene);
+
+  std::atomic<unsigned long> protocol_errors; ///< misused handshakes
+  std::atomic<unsigned long> control_writes;  ///< CONTROL_SETUP writes
+
+private:
+  std::mutex _bus;               ///< serialises single transactions
+  uint8_t _vregs[EMU_NUM_VREGS]; ///< virtual register contents
+  uint8_t _status;               ///< AS726X_SLAVE_STATUS_REG
+  uint8_t _rx;                   ///< AS726X_SLAVE_READ_REG
+  int _pending_write;            ///< virtual register awaiting data, or -1
+
+  uint32_t _scene[EMU_NUM_CHANNELS]; ///< light level in GAIN_64X counts
+  bool _has_scene;                   ///< true once setScene() was called
+
+  void convert();
+};
+
+extern EmulatedAS726x as726x_emulator; ///< the sensor on the emulated bus
+
+#endif
@@ -0,0 +1,36 @@
+/*!
+ * @file test_util.h
+ *
+ * Minimal assertion helpers shared by the host tests
+ *
+ */
+
+#ifndef AS726X_TEST_UTIL_H
+#define AS726X_TEST_UTIL_H
+
+#include <stdio.h>
+
+static unsigned long test_failures = 0; ///< failed CHECK()s so far
+
+/*!
+    @brief  Record a failure, with its location, if cond is false
+*/
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond);          \
+      test_failures++;                                                         \
+    }                                                                          \
+  } while (0)
+
+/*!
+    @brief  Print a summary line for the test program
+    @param name the test program name
+    @return the process exit code, 0 if every check passed
+*/
+static inline int test_summary(const char *name) {
+  printf("%s: %lu failure(s)\n", name, test_failures);
+  return test_failures ? 1 : 0;
+}
+
+#endif